@@ -30,13 +30,51 @@ native_require = require
 local __bundleit__ = {{
     modules = {{}},
     loaded = {{}},
+    dependents = {{}},
+    loading = {{}},
 }}
 
 {format_modules(modules)}
 
+-- Запоминает, какой модуль (тот, что сейчас исполняется) запросил
+-- module_name. Нужно для горячей перезагрузки зависимых модулей
+local function track_dependency(module_name)
+    local requirer = __bundleit__.loading[#__bundleit__.loading]
+
+    if requirer then
+        local requirers = __bundleit__.dependents[module_name] or {{}}
+        __bundleit__.dependents[module_name] = requirers
+        requirers[requirer] = true
+    end
+end
+
+-- Исполняет чанк модуля. Старые связи модуля сбрасываются, так как при
+-- повторном исполнении он может запросить другие модули
+function __bundleit__.run(module_name, func)
+    for _, requirers in pairs(__bundleit__.dependents) do
+        requirers[module_name] = nil
+    end
+
+    local loading = __bundleit__.loading
+    loading[#loading + 1] = module_name
+
+    local ok, result = pcall(func)
+    loading[#loading] = nil
+
+    if not ok then
+        error(result, 0)
+    end
+
+    return result
+end
+
 function __bundleit__.require(module_name)
     module_name = string.lower(module_name)
 
+    if __bundleit__.modules[module_name] then
+        track_dependency(module_name)
+    end
+
     if __bundleit__.loaded[module_name] then
         return __bundleit__.loaded[module_name]
     end
@@ -49,7 +87,7 @@ function __bundleit__.require(module_name)
             error("error loading module " .. module_name .. ":\\n" .. err)
         end
 
-        local result = func()
+        local result = __bundleit__.run(module_name, func)
         __bundleit__.loaded[module_name] = result or true
         return __bundleit__.loaded[module_name]
     end
@@ -61,6 +99,9 @@ end
 
 require = __bundleit__.require
 
+-- Нужно контейнеру для горячей перезагрузки модулей (--hot-reload)
+_G.__bundleit__ = __bundleit__
+
 {main_content}
 """
 
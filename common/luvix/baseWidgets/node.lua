@@ -1,5 +1,7 @@
 local M = {}
 
+local hashCache = require("luvix.render.hashCache")
+
 local NodePrototype = {}
 
 function M.createHandle(rawWidget, isContainer)
@@ -23,6 +25,7 @@ function M.createHandle(rawWidget, isContainer)
 		__newindex = function(t, k, v)
 			if t._internal[k] ~= v then
 				t._internal[k] = v
+				hashCache.invalidate(t._internal)
 			end
 		end
 	}
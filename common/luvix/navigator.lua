@@ -16,13 +16,33 @@ M.gotoScreen = function(path, args)
             return
         end
 
+        M.currentPath = path
+        M.currentArgs = args
+
         local widgetTree = screen.build(args)
         
+        --
+        -- Сравниваем с деревом, которое сейчас на экране, а не с пустым.
+        -- Так при повторном переходе на тот же экран одинаковые поддеревья
+        -- пропускаются по хэшу
+        --
+
+        renderPass.previousTree = renderPass.currentTree
         renderPass.currentTree = widgetTree
-        renderPass.previousTree = {}
 
         renderPass.update()
     -- end)
 end
 
+--
+-- Перестраивает текущий экран. Вызывается контейнером после горячей
+-- перезагрузки модулей
+--
+
+M.reload = function()
+    if M.currentPath then
+        M.gotoScreen(M.currentPath, M.currentArgs)
+    end
+end
+
 return M
\ No newline at end of file
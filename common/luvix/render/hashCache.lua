@@ -0,0 +1,69 @@
+local M = {}
+
+--
+-- Кэш структурных хэшей виджетов. Ключи слабые, поэтому старые деревья
+-- собираются сборщиком мусора вместе со своими хэшами. В parents значения
+-- тоже слабые: в LuaJIT нет эфемеронов, и сильная ссылка на родителя
+-- (который через children держит ребёнка) не дала бы собрать ни одно дерево
+--
+
+local weakKeys = { __mode = "k" }
+local weakKeysAndValues = { __mode = "kv" }
+
+M.nodes = setmetatable({}, weakKeys)
+M.subtrees = setmetatable({}, weakKeys)
+M.parents = setmetatable({}, weakKeysAndValues)
+
+M.hits = 0
+M.misses = 0
+
+function M.isAvailable()
+    return runtime ~= nil and runtime.hashTree ~= nil
+end
+
+function M.subtree(widget)
+    return runtime.hashTree(widget, M)
+end
+
+function M.node(widget)
+    local hash = M.nodes[widget]
+
+    if not hash then
+        hash = runtime.hashWidget(widget)
+        M.nodes[widget] = hash
+    end
+
+    return hash
+end
+
+--
+-- Сбрасывает хэш узла и хэши всех поддеревьев выше него. Вызывается
+-- при изменении свойства через handle. Изменения вложенных таблиц
+-- (children, layout) напрямую кэш не видит
+--
+
+function M.invalidate(widget)
+    M.nodes[widget] = nil
+
+    while widget do
+        M.subtrees[widget] = nil
+        widget = M.parents[widget]
+    end
+end
+
+function M.resetStats()
+    M.hits = 0
+    M.misses = 0
+end
+
+function M.report()
+    local total = M.hits + M.misses
+
+    if total == 0 then
+        return
+    end
+
+    print(string.format("HASH HITS: %d/%d (%.1f%%)", M.hits, total, M.hits / total * 100))
+end
+
+return M
@@ -1,11 +1,23 @@
 local M = {}
 
+local hashCache = require("luvix.render.hashCache")
+
 M.currentTree = {}
 M.previousTree = {}
 
 function M.update()
-    local mutations = table.findMutations(M.previousTree, M.currentTree)
+    local hashes = hashCache.isAvailable() and hashCache or nil
+
+    if hashes then
+        hashes.resetStats()
+    end
+
+    local mutations = table.findMutations(M.previousTree, M.currentTree, hashes)
     table.printMutations(mutations)
+
+    if hashes then
+        hashes.report()
+    end
 end
 
 return M
\ No newline at end of file
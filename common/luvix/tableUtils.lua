@@ -25,7 +25,61 @@ return { init = function(object)
         return copy
     end    
 
-    function object.findMutations(oldTree, newTree)
+    --
+    -- Сравнивает значения свойств по тем же правилам, что и структурный
+    -- хэш (structuralHash.cpp): вложенные таблицы сравниваются по
+    -- содержимому до глубины 8, а виджеты, их handle и более глубокие
+    -- таблицы - по ссылке. Так новый layout = {} на каждом build не
+    -- считается изменением
+    --
+
+    local maxTableDepth = 8
+
+    local function isWidgetTable(value)
+        return rawget(value, "_internal") ~= nil or rawget(value, "handle") ~= nil
+    end
+
+    function object.sameValue(a, b, depth)
+        if a == b then
+            return true
+        end
+
+        if type(a) ~= "table" or type(b) ~= "table" then
+            return false
+        end
+
+        depth = depth or 0
+
+        if depth >= maxTableDepth or isWidgetTable(a) or isWidgetTable(b) then
+            return false
+        end
+
+        local count = 0
+
+        for k, v in pairs(a) do
+            if not object.sameValue(v, rawget(b, k), depth + 1) then
+                return false
+            end
+
+            count = count + 1
+        end
+
+        for _ in pairs(b) do
+            count = count - 1
+        end
+
+        return count == 0
+    end
+
+    --
+    -- hashes - необязательный кэш структурных хэшей (luvix.render.hashCache).
+    -- Если он передан, одинаковые поддеревья пропускаются без обхода, а
+    -- свойства узлов с одинаковым хэшем не сравниваются через pairs. Оба
+    -- пути сравнивают свойства через object.sameValue, поэтому результат
+    -- не зависит от того, есть кэш или нет
+    --
+
+    function object.findMutations(oldTree, newTree, hashes)
         if oldTree == newTree then
             return {}
         end
@@ -67,21 +121,31 @@ return { init = function(object)
                     widget = oldWidget, 
                     path = current.path
                 }
+            elseif oldIsWidget and newIsWidget and hashes and hashes.subtree(oldWidget) == hashes.subtree(newWidget) then
+                hashes.hits = hashes.hits + 1
             elseif oldIsWidget and newIsWidget then
                 local propertyChanges = {}
+                local sameProps = false
+
+                if hashes then
+                    hashes.misses = hashes.misses + 1
+                    sameProps = hashes.node(oldWidget) == hashes.node(newWidget)
+                end
                 
-                for k, v in pairs(oldWidget) do
-                    if k ~= "handle" and k ~= "_internal" and k ~= "children" and k ~= "key" then
-                        if newWidget[k] ~= v then
-                            propertyChanges[k] = {old = v, new = newWidget[k]}
+                if not sameProps then
+                    for k, v in pairs(oldWidget) do
+                        if k ~= "handle" and k ~= "_internal" and k ~= "children" and k ~= "key" then
+                            if not object.sameValue(newWidget[k], v) then
+                                propertyChanges[k] = {old = v, new = newWidget[k]}
+                            end
                         end
                     end
-                end
 
-                for k, v in pairs(newWidget) do
-                    if k ~= "handle" and k ~= "_internal" and k ~= "children" and k ~= "key" then
-                        if oldWidget[k] ~= v and not propertyChanges[k] then
-                            propertyChanges[k] = {old = oldWidget[k], new = v}
+                    for k, v in pairs(newWidget) do
+                        if k ~= "handle" and k ~= "_internal" and k ~= "children" and k ~= "key" then
+                            if not propertyChanges[k] and not object.sameValue(oldWidget[k], v) then
+                                propertyChanges[k] = {old = oldWidget[k], new = v}
+                            end
                         end
                     end
                 end
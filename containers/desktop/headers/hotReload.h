@@ -0,0 +1,36 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+class LxRuntime;
+enum class LxReloadResult;
+
+/*
+    Режим разработки: следит за директорией с исходниками через
+    inotify и перезагружает изменённые модули на живом состоянии Lua
+    без перезапуска контейнера. Работает только на Linux
+*/
+
+class LxHotReload {
+    public:
+        LxHotReload();
+        ~LxHotReload();
+
+        bool start(const std::string& sourceDir, const std::string& mainFile = "main.lua");
+        void poll(LxRuntime& runtime);
+        void stop();
+
+    private:
+        void addWatch(const std::string& directory);
+        std::string moduleName(const std::string& path) const;
+        LxReloadResult reloadFile(LxRuntime& runtime, const std::string& name, const std::string& path);
+        std::vector<std::string> reloadOrder(LxRuntime& runtime, const std::vector<std::string>& changed);
+
+        int m_fd;
+        std::string m_sourceDir;
+        std::string m_mainFile;
+        std::map<int, std::string> m_watches;
+        std::map<std::string, std::string> m_modulePaths;
+};
@@ -26,6 +26,13 @@ typedef struct {
     int id;
     lua_State* L;
 
+    /*
+        Имя чанка, в котором объявлена функция слушателя. Для модулей
+        бандла совпадает с именем модуля, нужно для горячей перезагрузки
+    */
+
+    std::string module;
+
     bool isValid() const {
         return L != nullptr && id >= 0 && ref != LUA_REFNIL && ref != LUA_NOREF;
     }
@@ -41,6 +48,17 @@ typedef struct {
     }
 } LxEvent;
 
+/*
+    Результат горячей перезагрузки модуля: заменён, отложен до
+    первого require (модуль ещё не загружен) или ошибка
+*/
+
+enum class LxReloadResult {
+    Reloaded,
+    Deferred,
+    Failed
+};
+
 class LxRuntime {
     public:
         LxRuntime();
@@ -52,6 +70,11 @@ class LxRuntime {
         void callEnterFrameEvents(double time, int width, int height);
         void callResizeWindowEvents(int width, int height);
 
+        LxReloadResult reloadModule(const std::string& name, const std::string& source);
+        std::vector<std::string> moduleDependents(const std::string& name);
+        void refreshScreen();
+        std::string currentScreen();
+
     private:
         lua_State* m_lua;
         
@@ -59,6 +82,9 @@ class LxRuntime {
         static int l_removeEventListener(lua_State* L);
         static int l_getScreenInfo(lua_State* L);
 
+        std::vector<int> moduleListenerIds(const std::string& module);
+        void removeListeners(const std::vector<int>& ids);
+
         void safeCallListeners(std::vector<LxEvent>& listeners, const char* eventName, std::function<void(lua_State*)> pushArgs);
 
         std::vector<LxEvent> m_enterFrameEvents;
@@ -66,6 +92,4 @@ class LxRuntime {
 
         int m_enterFrameEventRef;
         int m_resizeEventRef;
-};
-
-static int l_get_proc_address(lua_State* L);
\ No newline at end of file
+};
\ No newline at end of file
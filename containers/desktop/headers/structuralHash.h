@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+    #include <lua.h>
+    #include <lauxlib.h>
+}
+
+/*
+    Структурный хэш виджетов. Используется при реконсиляции, чтобы
+    пропускать одинаковые поддеревья за O(1) вместо сравнения
+    каждого свойства через pairs
+*/
+
+namespace LxStructuralHash {
+    uint64_t hashWidget(lua_State* L, int index);
+
+    int l_hashWidget(lua_State* L);
+    int l_hashTree(lua_State* L);
+}
@@ -0,0 +1,370 @@
+/*
+    HotReload.cpp - часть десктоп контейнера фреймворка Luvix,
+    горячая перезагрузка модулей бандла в режиме разработки
+
+    Отвечает за:
+        Следить за директорией с исходниками (inotify)
+        Перекомпилировать только изменённые модули между кадрами
+        Перезапускать текущий экран и выводить время перезагрузки
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include "headers/hotReload.h"
+#include "headers/runtime.h"
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+LxHotReload::LxHotReload() {
+    m_fd = -1;
+}
+
+LxHotReload::~LxHotReload() {
+    stop();
+}
+
+/*
+    Начинает следить за директорией sourceDir (та же директория, которая
+    передаётся в bundleit.py). mainFile - точка входа бандла, её нельзя
+    перезагрузить без перезапуска
+*/
+
+bool LxHotReload::start(const std::string& sourceDir, const std::string& mainFile) {
+#ifdef __linux__
+    std::error_code error;
+
+    if (!std::filesystem::is_directory(sourceDir, error)) {
+        std::cerr << "Hot Reload Error: " << sourceDir << " is not a directory" << std::endl;
+        return false;
+    }
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (m_fd < 0) {
+        std::cerr << "Hot Reload Error: inotify_init1 failed" << std::endl;
+        return false;
+    }
+
+    m_sourceDir = std::filesystem::canonical(sourceDir).string();
+    m_mainFile = mainFile;
+
+    std::transform(m_mainFile.begin(), m_mainFile.end(), m_mainFile.begin(), ::tolower);
+
+    /*
+        inotify не умеет следить рекурсивно, поэтому добавляем
+        наблюдение на каждую поддиректорию
+    */
+
+    addWatch(m_sourceDir);
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(m_sourceDir, error)) {
+        if (entry.is_directory()) {
+            addWatch(entry.path().string());
+        } else if (entry.path().extension() == ".lua") {
+            m_modulePaths[moduleName(entry.path().string())] = entry.path().string();
+        }
+    }
+
+    std::cout << "[INFO] Hot reload: watching " << m_sourceDir << std::endl;
+    return true;
+#else
+    (void)sourceDir;
+    (void)mainFile;
+
+    std::cerr << "Hot Reload Error: hot reload is only supported on Linux" << std::endl;
+    return false;
+#endif
+}
+
+void LxHotReload::stop() {
+#ifdef __linux__
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+
+    m_watches.clear();
+    m_modulePaths.clear();
+}
+
+void LxHotReload::addWatch(const std::string& directory) {
+#ifdef __linux__
+    int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+
+    if (wd >= 0) {
+        m_watches[wd] = directory;
+    }
+#else
+    (void)directory;
+#endif
+}
+
+/*
+    Имя модуля считается так же, как в bundleit.py: путь относительно
+    директории с исходниками, разделители заменены на точки, без .lua
+    и в нижнем регистре
+*/
+
+std::string LxHotReload::moduleName(const std::string& path) const {
+    std::string name = std::filesystem::path(path).lexically_relative(m_sourceDir).generic_string();
+    name = name.substr(0, name.size() - 4);
+
+    std::replace(name.begin(), name.end(), '/', '.');
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    return name;
+}
+
+/*
+    Модули фреймворка (luvix.*) хранят состояние (navigator, renderPass,
+    hashCache, liana) и уже лежат в локальных переменных других модулей
+    и в глобальной таблице luvix. Замена такого модуля разделила бы
+    состояние на две копии, поэтому их перезагрузка не поддерживается
+*/
+
+static bool isFrameworkModule(const std::string& name) {
+    return name.rfind("luvix.", 0) == 0;
+}
+
+LxReloadResult LxHotReload::reloadFile(LxRuntime& runtime, const std::string& name, const std::string& path) {
+    std::ifstream stream(path, std::ios::binary);
+
+    if (!stream) {
+        return LxReloadResult::Failed;
+    }
+
+    std::stringstream source;
+    source << stream.rdbuf();
+
+    return runtime.reloadModule(name, source.str());
+}
+
+/*
+    Порядок перезагрузки: изменённые модули и все модули, которые от них
+    зависят (запросили их через require во время исполнения), так чтобы
+    каждый модуль исполнялся после своих зависимостей. Иначе модуль,
+    который держит local X = require(...), остался бы со старым X
+*/
+
+std::vector<std::string> LxHotReload::reloadOrder(LxRuntime& runtime, const std::vector<std::string>& changed) {
+    std::map<std::string, std::vector<std::string>> dependents;
+    std::vector<std::string> pending(changed.begin(), changed.end());
+    std::set<std::string> affected(changed.begin(), changed.end());
+
+    while (!pending.empty()) {
+        std::string name = pending.back();
+        pending.pop_back();
+
+        for (const std::string& dependent : runtime.moduleDependents(name)) {
+            if (isFrameworkModule(dependent)) {
+                std::cout << "[WARN] Hot reload: framework module " << dependent << " uses " << name << ", restart required" << std::endl;
+                continue;
+            }
+
+            dependents[name].push_back(dependent);
+
+            if (affected.insert(dependent).second) {
+                pending.push_back(dependent);
+            }
+        }
+    }
+
+    /*
+        Топологическая сортировка (Kahn): сначала модули, у которых нет
+        зависимостей среди перезагружаемых
+    */
+
+    std::map<std::string, int> dependencyCount;
+
+    for (const std::string& name : affected) {
+        dependencyCount[name] += 0;
+
+        for (const std::string& dependent : dependents[name]) {
+            dependencyCount[dependent]++;
+        }
+    }
+
+    std::vector<std::string> order;
+    std::vector<std::string> ready;
+
+    for (const auto& entry : dependencyCount) {
+        if (entry.second == 0) {
+            ready.push_back(entry.first);
+        }
+    }
+
+    while (!ready.empty()) {
+        std::string name = ready.back();
+        ready.pop_back();
+        order.push_back(name);
+
+        for (const std::string& dependent : dependents[name]) {
+            if (--dependencyCount[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+
+    /*
+        Циклические require: такие модули добавляются в конец в
+        произвольном порядке
+    */
+
+    for (const auto& entry : dependencyCount) {
+        if (entry.second > 0) {
+            order.push_back(entry.first);
+        }
+    }
+
+    return order;
+}
+
+/*
+    Вызывается из главного цикла между кадрами. Если с прошлого кадра
+    изменились .lua файлы - перезагружает их модули и перестраивает
+    текущий экран
+*/
+
+void LxHotReload::poll(LxRuntime& runtime) {
+#ifdef __linux__
+    if (m_fd < 0) {
+        return;
+    }
+
+    /*
+        Редакторы часто пишут файл несколько раз подряд, поэтому
+        собираем все изменения за кадр в set
+    */
+
+    std::set<std::string> changedFiles;
+    alignas(struct inotify_event) char buffer[4096];
+
+    for (;;) {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+
+        if (length <= 0) {
+            break;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            auto watch = m_watches.find(event->wd);
+
+            if (watch == m_watches.end() || event->len == 0) {
+                continue;
+            }
+
+            std::filesystem::path path = std::filesystem::path(watch->second) / event->name;
+
+            if (event->mask & IN_ISDIR) {
+                addWatch(path.string());
+                continue;
+            }
+
+            if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && path.extension() == ".lua") {
+                changedFiles.insert(path.string());
+            }
+        }
+    }
+
+    if (changedFiles.empty()) {
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::string> changed;
+
+    for (const std::string& file : changedFiles) {
+        std::string name = moduleName(file);
+        m_modulePaths[name] = file;
+
+        std::string fileName = std::filesystem::path(file).filename().string();
+        std::transform(fileName.begin(), fileName.end(), fileName.begin(), ::tolower);
+
+        if (fileName == m_mainFile) {
+            std::cout << "[WARN] Hot reload: " << file << " is the entry point, restart required" << std::endl;
+            continue;
+        }
+
+        if (isFrameworkModule(name)) {
+            std::cout << "[WARN] Hot reload: " << name << " is a framework module, restart required" << std::endl;
+            continue;
+        }
+
+        changed.push_back(name);
+    }
+
+    std::set<std::string> reloaded;
+    int deferred = 0;
+    int failed = 0;
+
+    for (const std::string& name : reloadOrder(runtime, changed)) {
+        auto path = m_modulePaths.find(name);
+
+        if (path == m_modulePaths.end()) {
+            continue;
+        }
+
+        switch (reloadFile(runtime, name, path->second)) {
+            case LxReloadResult::Reloaded:
+                reloaded.insert(name);
+                break;
+
+            case LxReloadResult::Deferred:
+                deferred++;
+                break;
+
+            case LxReloadResult::Failed:
+                failed++;
+                break;
+        }
+    }
+
+    if (reloaded.empty()) {
+        if (deferred > 0) {
+            std::cout << "[INFO] Hot reload: " << deferred << " module(s) not loaded yet, will load on require" << std::endl;
+        }
+
+        return;
+    }
+
+    /*
+        Экран запрашивается navigator.gotoScreen уже после загрузки
+        бандла, поэтому в зависимостях его может не быть. Исполняем его
+        заново при любой перезагрузке
+    */
+
+    std::string screen = runtime.currentScreen();
+    auto screenPath = m_modulePaths.find(screen);
+
+    if (!screen.empty() && !reloaded.count(screen) && !isFrameworkModule(screen) && screenPath != m_modulePaths.end()) {
+        reloadFile(runtime, screen, screenPath->second);
+    }
+
+    runtime.refreshScreen();
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "[INFO] Hot reload: " << reloaded.size() << " module(s) reloaded";
+
+    if (failed > 0) {
+        std::cout << ", " << failed << " failed";
+    }
+
+    std::cout << " in " << elapsed << " ms" << std::endl;
+#else
+    (void)runtime;
+#endif
+}
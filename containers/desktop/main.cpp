@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "headers/runtime.h"
+#include "headers/hotReload.h"
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -84,6 +85,20 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
 bool verbose = false;
 bool vsync = true;
 
+/*
+    Директория с исходниками для горячей перезагрузки (--hot-reload <dir>).
+    Пустая строка - режим разработки выключен
+*/
+
+std::string hotReloadDir;
+
+/*
+    Точка входа бандла (то же, что -m в bundleit.py). Её нельзя
+    перезагрузить без перезапуска
+*/
+
+std::string hotReloadMain = "main.lua";
+
 /*
     Эта функция нужна для гибкости. В случае, если в сообщение
     нужно будет добавить больше информации - изменение нужно будет
@@ -104,11 +119,22 @@ int main(int argc, char* argv[]) {
         активируем подробную отладку.
     */
 
-    for (const auto& arg : args) {
-        if (arg == "--verbose") {
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--verbose") {
             verbose = true;
-        } else if (arg == "--no-vsync") {
+        } else if (args[i] == "--no-vsync") {
             vsync = false;
+        } else if (args[i] == "--hot-reload" || args[i] == "--hot-reload-main") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "[WARN] " << args[i] << " requires an argument, ignored" << std::endl;
+                continue;
+            }
+
+            if (args[i] == "--hot-reload") {
+                hotReloadDir = args[++i];
+            } else {
+                hotReloadMain = args[++i];
+            }
         }
     }
     
@@ -204,7 +230,19 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    /*
+        Режим разработки: изменённые модули перезагружаются между
+        кадрами без перезапуска контейнера
+    */
+
+    LxHotReload hotReload;
+
+    if (!hotReloadDir.empty()) {
+        hotReload.start(hotReloadDir, hotReloadMain);
+    }
+
     while (!glfwWindowShouldClose(window)) {
+        hotReload.poll(runtime);
         runtime.callEnterFrameEvents(glfwGetTime(), widthScreen, heightScreen);
         
         glfwPollEvents();
@@ -8,9 +8,12 @@
         Передавать актуальную информацию об окне
 */
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 
 #include "headers/runtime.h"
+#include "headers/structuralHash.h"
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -21,6 +24,8 @@
 
 static const char* LX_RUNTIME_KEY = "LxRuntimeInstance";
 
+static int l_get_proc_address(lua_State* L);
+
 /*
     Статичная функция для создания глобальной таблицы в состоянии
     lua
@@ -139,6 +144,14 @@ int LxRuntime::boot(const std::string& bootFile) {
     addFunctionToTable("runtime", "getProcAddress", l_get_proc_address, m_lua);
     addFunctionToTable("runtime", "getScreenInfo", l_getScreenInfo, m_lua);
 
+    /*
+        Структурный хэш виджетов для реконсиляции. Считать его в C
+        быстрее, чем обходить каждое свойство через pairs в Lua
+    */
+
+    addFunctionToTable("runtime", "hashWidget", LxStructuralHash::l_hashWidget, m_lua);
+    addFunctionToTable("runtime", "hashTree", LxStructuralHash::l_hashTree, m_lua);
+
     /*
         Загружаеи чанк для проверки на синтаксические ошибки и выполняем его с проверкой
         на панику Lua чтобы отладить, например, вызов функции которой нет (И другие случаи
@@ -173,7 +186,13 @@ void LxRuntime::safeCallListeners(std::vector<LxEvent>& listeners, const char* e
         LxEvent& event = listeners[i];
         lua_State* L = event.L;
         
+        /*
+            Слушатель уже отписан (makeInvalid обнуляет L), убираем
+            запись из вектора
+        */
+
         if (!L) {
+            listeners.erase(listeners.begin() + i);
             continue;
         }
 
@@ -294,6 +313,19 @@ int LxRuntime::l_addEventListener(lua_State* L) {
     newEvent.ref = ref;
     newEvent.id = nextId++;
 
+    /*
+        Запоминаем чанк, из которого вызвали addEventListener (а не тот,
+        где объявлена функция): при перезагрузке этот модуль исполнится
+        заново и подпишется снова. Модули бандла загружаются через
+        load(code, moduleName), поэтому source совпадает с именем модуля
+    */
+
+    lua_Debug ar;
+    
+    if (lua_getstack(L, 1, &ar) && lua_getinfo(L, "S", &ar) && ar.source) {
+        newEvent.module = ar.source;
+    }
+
     switch (type) {
         case EventType::EnterFrame:
             runtime->m_enterFrameEvents.push_back(newEvent);
@@ -317,6 +349,10 @@ int LxRuntime::l_addEventListener(lua_State* L) {
 static void removeFromVector(std::vector<LxEvent>* vector, int id) {
     for (size_t i = 0; i < vector->size(); ++i) {
         if ((*vector)[i].id == id) {
+            if ((*vector)[i].isValid()) {
+                luaL_unref((*vector)[i].L, LUA_REGISTRYINDEX, (*vector)[i].ref);
+            }
+
             (*vector)[i].makeInvalid();
             
             return;
@@ -351,6 +387,256 @@ int LxRuntime::l_removeEventListener(lua_State* L) {
     return 0;
 }
 
+/*
+    Возвращает id всех слушателей, функции которых объявлены в модуле
+    module
+*/
+
+std::vector<int> LxRuntime::moduleListenerIds(const std::string& module) {
+    std::vector<int> ids;
+
+    for (const std::vector<LxEvent>* listeners : { &m_enterFrameEvents, &m_resizeWindowEvents }) {
+        for (const LxEvent& event : *listeners) {
+            if (event.isValid() && event.module == module) {
+                ids.push_back(event.id);
+            }
+        }
+    }
+
+    return ids;
+}
+
+/*
+    Отписывает слушатели по id и сразу удаляет их записи из векторов.
+    Вызывается только между кадрами, поэтому векторы в этот момент
+    не обходятся в safeCallListeners
+*/
+
+void LxRuntime::removeListeners(const std::vector<int>& ids) {
+    for (int id : ids) {
+        removeFromVector(&m_enterFrameEvents, id);
+        removeFromVector(&m_resizeWindowEvents, id);
+    }
+
+    for (std::vector<LxEvent>* listeners : { &m_enterFrameEvents, &m_resizeWindowEvents }) {
+        listeners->erase(std::remove_if(listeners->begin(), listeners->end(), [](const LxEvent& event) {
+            return !event.isValid();
+        }), listeners->end());
+    }
+}
+
+/*
+    Горячая перезагрузка одного модуля бандла на живом состоянии Lua.
+    Модуль компилируется и исполняется заново, результат заменяет
+    __bundleit__.loaded[name]. Слушатели старой версии модуля
+    отписываются только если новая версия исполнилась без ошибок,
+    иначе остаётся старая версия и отписываются слушатели новой.
+
+    Если модуль ещё никто не запрашивал, обновляется только его
+    исходник в __bundleit__.modules, а исполнит его require
+*/
+
+LxReloadResult LxRuntime::reloadModule(const std::string& name, const std::string& source) {
+    if (!m_lua) {
+        return LxReloadResult::Failed;
+    }
+
+    int top = lua_gettop(m_lua);
+
+    lua_getglobal(m_lua, "__bundleit__");
+
+    if (!lua_istable(m_lua, -1)) {
+        std::cerr << "Hot Reload Error: bundle has no __bundleit__ table, rebuild it with bundleit.py" << std::endl;
+        lua_settop(m_lua, top);
+        return LxReloadResult::Failed;
+    }
+
+    int bundle = lua_gettop(m_lua);
+
+    if (luaL_loadbuffer(m_lua, source.data(), source.size(), name.c_str()) != LUA_OK) {
+        std::cerr << "Hot Reload Load Error: " << lua_tostring(m_lua, -1) << std::endl;
+        lua_settop(m_lua, top);
+        return LxReloadResult::Failed;
+    }
+
+    int chunk = lua_gettop(m_lua);
+
+    lua_getfield(m_lua, bundle, "loaded");
+    lua_getfield(m_lua, -1, name.c_str());
+    bool loaded = !lua_isnil(m_lua, -1);
+    lua_pop(m_lua, 2);
+
+    if (!loaded) {
+        lua_getfield(m_lua, bundle, "modules");
+        lua_pushlstring(m_lua, source.data(), source.size());
+        lua_setfield(m_lua, -2, name.c_str());
+
+        lua_settop(m_lua, top);
+        return LxReloadResult::Deferred;
+    }
+
+    std::vector<int> oldListeners = moduleListenerIds(name);
+
+    /*
+        Исполняем через __bundleit__.run, чтобы бандл заново записал,
+        какие модули запрашивает этот
+    */
+
+    lua_getfield(m_lua, bundle, "run");
+
+    if (lua_isfunction(m_lua, -1)) {
+        lua_pushstring(m_lua, name.c_str());
+        lua_pushvalue(m_lua, chunk);
+    } else {
+        lua_pop(m_lua, 1);
+        lua_pushvalue(m_lua, chunk);
+    }
+
+    int argumentCount = lua_gettop(m_lua) - chunk - 1;
+
+    if (lua_pcall(m_lua, argumentCount, 1, 0) != LUA_OK) {
+        std::cerr << "Hot Reload Execution Error (" << name << "): " << lua_tostring(m_lua, -1) << std::endl;
+        
+        std::vector<int> newListeners;
+        
+        for (int id : moduleListenerIds(name)) {
+            if (std::find(oldListeners.begin(), oldListeners.end(), id) == oldListeners.end()) {
+                newListeners.push_back(id);
+            }
+        }
+
+        removeListeners(newListeners);
+        lua_settop(m_lua, top);
+        return LxReloadResult::Failed;
+    }
+
+    removeListeners(oldListeners);
+
+    /*
+        Так же как __bundleit__.require: модуль без return
+        сохраняется как true
+    */
+
+    if (lua_isnil(m_lua, -1)) {
+        lua_pop(m_lua, 1);
+        lua_pushboolean(m_lua, 1);
+    }
+
+    int result = lua_gettop(m_lua);
+
+    lua_getfield(m_lua, bundle, "loaded");
+    lua_pushvalue(m_lua, result);
+    lua_setfield(m_lua, -2, name.c_str());
+    lua_pop(m_lua, 1);
+
+    lua_getfield(m_lua, bundle, "modules");
+    lua_pushlstring(m_lua, source.data(), source.size());
+    lua_setfield(m_lua, -2, name.c_str());
+
+    lua_settop(m_lua, top);
+    return LxReloadResult::Reloaded;
+}
+
+/*
+    Возвращает модули бандла, которые запросили модуль name во время
+    своего исполнения (__bundleit__.dependents[name])
+*/
+
+std::vector<std::string> LxRuntime::moduleDependents(const std::string& name) {
+    std::vector<std::string> dependents;
+
+    if (!m_lua) {
+        return dependents;
+    }
+
+    int top = lua_gettop(m_lua);
+
+    lua_getglobal(m_lua, "__bundleit__");
+
+    if (lua_istable(m_lua, -1)) {
+        lua_getfield(m_lua, -1, "dependents");
+
+        if (lua_istable(m_lua, -1)) {
+            lua_getfield(m_lua, -1, name.c_str());
+
+            if (lua_istable(m_lua, -1)) {
+                int requirers = lua_gettop(m_lua);
+                lua_pushnil(m_lua);
+
+                while (lua_next(m_lua, requirers) != 0) {
+                    if (lua_type(m_lua, -2) == LUA_TSTRING) {
+                        dependents.push_back(lua_tostring(m_lua, -2));
+                    }
+
+                    lua_pop(m_lua, 1);
+                }
+            }
+        }
+    }
+
+    lua_settop(m_lua, top);
+    return dependents;
+}
+
+/*
+    Перестраивает текущий экран через navigator.reload, чтобы
+    перезагруженные модули попали на экран
+*/
+
+void LxRuntime::refreshScreen() {
+    if (!m_lua) {
+        return;
+    }
+
+    int top = lua_gettop(m_lua);
+
+    lua_getglobal(m_lua, "require");
+    lua_pushstring(m_lua, "luvix.navigator");
+
+    if (lua_pcall(m_lua, 1, 1, 0) != LUA_OK) {
+        std::cerr << "Hot Reload Error: " << lua_tostring(m_lua, -1) << std::endl;
+        lua_settop(m_lua, top);
+        return;
+    }
+
+    lua_getfield(m_lua, -1, "reload");
+
+    if (lua_isfunction(m_lua, -1) && lua_pcall(m_lua, 0, 0, 0) != LUA_OK) {
+        std::cerr << "Hot Reload Error (gotoScreen): " << lua_tostring(m_lua, -1) << std::endl;
+    }
+
+    lua_settop(m_lua, top);
+}
+
+/*
+    Возвращает имя модуля текущего экрана (navigator.currentPath) в
+    нижнем регистре, как его хранит __bundleit__, или пустую строку
+*/
+
+std::string LxRuntime::currentScreen() {
+    if (!m_lua) {
+        return "";
+    }
+
+    int top = lua_gettop(m_lua);
+    std::string screen;
+
+    lua_getglobal(m_lua, "require");
+    lua_pushstring(m_lua, "luvix.navigator");
+
+    if (lua_pcall(m_lua, 1, 1, 0) == LUA_OK && lua_istable(m_lua, -1)) {
+        lua_getfield(m_lua, -1, "currentPath");
+
+        if (lua_type(m_lua, -1) == LUA_TSTRING) {
+            screen = lua_tostring(m_lua, -1);
+            std::transform(screen.begin(), screen.end(), screen.begin(), ::tolower);
+        }
+    }
+
+    lua_settop(m_lua, top);
+    return screen;
+}
+
 int LxRuntime::l_getScreenInfo(lua_State* L) {
     GLFWmonitor* monitor = glfwGetPrimaryMonitor();
     if (!monitor) {
@@ -0,0 +1,379 @@
+/*
+    StructuralHash.cpp - часть десктоп контейнера фреймворка Luvix,
+    считает 64-битный структурный хэш виджетов и их поддеревьев
+
+    Отвечает за:
+        Хэш свойств виджета (runtime.hashWidget)
+        Хэш поддерева с кэшированием по узлам (runtime.hashTree)
+
+    Хэш возвращается в Lua как строка из 16 hex символов. Строки в
+    Lua интернированы, поэтому сравнение двух хэшей через == стоит O(1),
+    а LuaJIT не может без потерь хранить uint64_t в number
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "headers/structuralHash.h"
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+/*
+    Ограничение глубины для вложенных таблиц в свойствах (layout, color
+    и так далее). Глубже хэшируется только адрес таблицы, это защищает
+    от циклических ссылок
+*/
+
+static const int MAX_TABLE_DEPTH = 8;
+
+/*
+    В LuaJIT нет lua_absindex, поэтому переводим относительный индекс
+    стека в абсолютный вручную
+*/
+
+static int absoluteIndex(lua_State* L, int index) {
+    if (index > 0 || index <= LUA_REGISTRYINDEX) {
+        return index;
+    }
+
+    return lua_gettop(L) + index + 1;
+}
+
+/*
+    Финализатор splitmix64, перемешивает биты чтобы близкие значения
+    давали далёкие хэши
+*/
+
+static uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31);
+}
+
+static uint64_t hashBytes(const char* data, size_t length) {
+    uint64_t hash = FNV_OFFSET;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/*
+    Те же ключи, которые пропускает table.findMutations. Пропускаются
+    только у самого виджета, во вложенных таблицах это обычные ключи
+*/
+
+static bool isIgnoredKey(lua_State* L, int keyIndex, bool topLevel) {
+    if (!topLevel || lua_type(L, keyIndex) != LUA_TSTRING) {
+        return false;
+    }
+
+    const char* key = lua_tostring(L, keyIndex);
+
+    return strcmp(key, "handle") == 0 || strcmp(key, "_internal") == 0 ||
+        strcmp(key, "children") == 0 || strcmp(key, "key") == 0;
+}
+
+/*
+    Виджет или его handle (таблица с полем _internal или handle). Если
+    такая таблица лежит в свойстве, она сравнивается по адресу, как
+    оператор ~=, а не по содержимому
+*/
+
+static bool isWidgetTable(lua_State* L, int index) {
+    index = absoluteIndex(L, index);
+    bool widget = false;
+
+    lua_pushstring(L, "_internal");
+    lua_rawget(L, index);
+    widget = !lua_isnil(L, -1);
+    lua_pop(L, 1);
+
+    if (!widget) {
+        lua_pushstring(L, "handle");
+        lua_rawget(L, index);
+        widget = !lua_isnil(L, -1);
+        lua_pop(L, 1);
+    }
+
+    return widget;
+}
+
+static uint64_t hashValue(lua_State* L, int index, int depth);
+
+/*
+    Хэш таблицы не зависит от порядка обхода pairs: хэши пар
+    ключ-значение складываются, а сложение коммутативно. Ключи-таблицы
+    хэшируются по адресу, так как поиск по ключу в Lua идёт по адресу
+*/
+
+static uint64_t hashTable(lua_State* L, int index, int depth, bool topLevel) {
+    index = absoluteIndex(L, index);
+    luaL_checkstack(L, 3, "table is too deep to hash");
+
+    uint64_t accumulator = 0;
+    uint64_t count = 0;
+
+    lua_pushnil(L);
+
+    while (lua_next(L, index) != 0) {
+        if (!isIgnoredKey(L, -2, topLevel)) {
+            uint64_t keyHash = hashValue(L, -2, MAX_TABLE_DEPTH);
+            uint64_t valueHash = hashValue(L, -1, depth);
+
+            accumulator += mix(keyHash * FNV_PRIME + valueHash);
+            count++;
+        }
+
+        lua_pop(L, 1);
+    }
+
+    return mix(accumulator ^ (count * FNV_PRIME));
+}
+
+/*
+    Тип значения перемешивается отдельно от его содержимого, иначе
+    например true и 0 давали бы одинаковый хэш
+*/
+
+static uint64_t hashTagged(int type, uint64_t payload) {
+    return mix(mix(static_cast<uint64_t>(type)) + payload);
+}
+
+static uint64_t hashValue(lua_State* L, int index, int depth) {
+    int type = lua_type(L, index);
+
+    switch (type) {
+        case LUA_TNIL:
+            return hashTagged(type, 0);
+
+        case LUA_TBOOLEAN:
+            return hashTagged(type, lua_toboolean(L, index));
+
+        case LUA_TNUMBER: {
+            /*
+                -0.0 == 0.0 в Lua, поэтому приводим их к одному виду
+                перед тем как брать биты
+            */
+
+            double number = lua_tonumber(L, index);
+            if (number == 0) {
+                number = 0;
+            }
+
+            uint64_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+
+            return hashTagged(type, bits);
+        }
+
+        case LUA_TSTRING: {
+            size_t length;
+            const char* data = lua_tolstring(L, index, &length);
+
+            return hashTagged(type, hashBytes(data, length));
+        }
+
+        case LUA_TTABLE:
+            if (depth < MAX_TABLE_DEPTH && !isWidgetTable(L, index)) {
+                return hashTagged(type, hashTable(L, index, depth + 1, false));
+            }
+
+            [[fallthrough]];
+
+        default:
+            /*
+                Функции, userdata, виджеты и слишком глубокие таблицы
+                сравниваются по адресу, так же как их сравнивает оператор ~=
+            */
+
+            return hashTagged(type, reinterpret_cast<uintptr_t>(lua_topointer(L, index)));
+    }
+}
+
+/*
+    Кладёт на стек сам виджет: если передан handle (таблица с полем
+    _internal), то берётся его _internal, иначе таблица как есть.
+    rawget используется чтобы не задевать метатаблицу handle
+*/
+
+static void pushResolvedWidget(lua_State* L, int index) {
+    index = absoluteIndex(L, index);
+
+    lua_pushstring(L, "_internal");
+    lua_rawget(L, index);
+
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_pushvalue(L, index);
+    }
+}
+
+static void pushHash(lua_State* L, uint64_t hash) {
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+
+    lua_pushlstring(L, buffer, 16);
+}
+
+static bool toHash(lua_State* L, int index, uint64_t* hash) {
+    if (lua_type(L, index) != LUA_TSTRING) {
+        return false;
+    }
+
+    *hash = strtoull(lua_tostring(L, index), nullptr, 16);
+    return true;
+}
+
+/*
+    Хэш свойств виджета, который уже лежит на стеке по индексу index
+    (не handle, а сам виджет)
+*/
+
+uint64_t LxStructuralHash::hashWidget(lua_State* L, int index) {
+    return hashTable(L, index, 0, true);
+}
+
+/*
+    Хэш поддерева: хэш свойств узла и упорядоченные пары (key, хэш
+    поддерева ребёнка). Результаты кладутся в таблицы кэша nodes и
+    subtrees, а в parents записывается родитель каждого ребёнка, чтобы
+    Lua сторона могла сбросить кэш вверх по дереву при изменении узла
+*/
+
+static uint64_t hashSubtree(lua_State* L, int widget, int nodes, int subtrees, int parents) {
+    luaL_checkstack(L, 8, "widget tree is too deep to hash");
+
+    uint64_t hash;
+
+    lua_pushvalue(L, widget);
+    lua_rawget(L, subtrees);
+    bool cached = toHash(L, -1, &hash);
+    lua_pop(L, 1);
+
+    if (cached) {
+        return hash;
+    }
+
+    uint64_t nodeHash;
+
+    lua_pushvalue(L, widget);
+    lua_rawget(L, nodes);
+
+    if (!toHash(L, -1, &nodeHash)) {
+        nodeHash = LxStructuralHash::hashWidget(L, widget);
+
+        lua_pushvalue(L, widget);
+        pushHash(L, nodeHash);
+        lua_rawset(L, nodes);
+    }
+
+    lua_pop(L, 1);
+
+    hash = mix(nodeHash ^ 0x7);
+    uint64_t childCount = 0;
+
+    lua_pushstring(L, "children");
+    lua_rawget(L, widget);
+
+    if (lua_istable(L, -1)) {
+        int children = lua_gettop(L);
+        int count = static_cast<int>(lua_objlen(L, children));
+
+        for (int i = 1; i <= count; ++i) {
+            lua_rawgeti(L, children, i);
+
+            if (lua_istable(L, -1)) {
+                pushResolvedWidget(L, -1);
+                int child = lua_gettop(L);
+
+                lua_pushstring(L, "key");
+                lua_rawget(L, child);
+                uint64_t keyHash = hashValue(L, -1, MAX_TABLE_DEPTH);
+                lua_pop(L, 1);
+
+                uint64_t childHash = hashSubtree(L, child, nodes, subtrees, parents);
+
+                lua_pushvalue(L, child);
+                lua_pushvalue(L, widget);
+                lua_rawset(L, parents);
+
+                /*
+                    Порядок детей важен, поэтому тут не сумма, а
+                    последовательное перемешивание
+                */
+
+                hash = mix(hash * FNV_PRIME + (keyHash ^ childHash));
+                childCount++;
+
+                lua_pop(L, 1);
+            }
+
+            lua_pop(L, 1);
+        }
+    }
+
+    lua_pop(L, 1);
+
+    hash = mix(hash ^ childCount);
+
+    lua_pushvalue(L, widget);
+    pushHash(L, hash);
+    lua_rawset(L, subtrees);
+
+    return hash;
+}
+
+/*
+    runtime.hashWidget(widget) -> string
+
+    Принимает виджет или его handle, возвращает хэш свойств без учёта
+    handle, _internal, children и key
+*/
+
+int LxStructuralHash::l_hashWidget(lua_State* L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    pushResolvedWidget(L, 1);
+    uint64_t hash = hashWidget(L, lua_gettop(L));
+    lua_pop(L, 1);
+
+    pushHash(L, hash);
+    return 1;
+}
+
+/*
+    runtime.hashTree(widget, cache) -> string
+
+    cache - таблица с полями nodes, subtrees и parents (обычно со слабыми
+    ключами). Поддеревья, хэш которых уже есть в cache.subtrees, не
+    обходятся повторно
+*/
+
+int LxStructuralHash::l_hashTree(lua_State* L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_settop(L, 2);
+
+    lua_getfield(L, 2, "nodes");
+    lua_getfield(L, 2, "subtrees");
+    lua_getfield(L, 2, "parents");
+
+    if (!lua_istable(L, 3) || !lua_istable(L, 4) || !lua_istable(L, 5)) {
+        return luaL_error(L, "hashTree cache must contain nodes, subtrees and parents tables");
+    }
+
+    pushResolvedWidget(L, 1);
+    uint64_t hash = hashSubtree(L, lua_gettop(L), 3, 4, 5);
+    lua_settop(L, 0);
+
+    pushHash(L, hash);
+    return 1;
+}